@@ -0,0 +1,74 @@
+/*
+ * Author: Mathew Lane
+ * Description: Declares the background worker that re-lists the shown directory and reports whether it differs from what's on screen.
+ * Date: 2026-02-02
+ */
+
+#ifndef DIRECTORY_REVALIDATOR_H
+#define DIRECTORY_REVALIDATOR_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "FileManagerLogic.h"
+#include "DirectorySnapshot.h"
+
+namespace fs = std::filesystem;
+
+// what the worker found for one request
+struct RevalidationResult {
+    unsigned long generation = 0;
+    fs::path path;
+    DirectoryStamp stamp;
+    std::vector<FileEntry> entries;
+    std::string error;
+    bool unchanged = false; // listing matches what was on screen, entries is left empty
+    bool missing = false;   // path isn't a readable directory
+};
+
+class DirectoryRevalidator {
+public:
+    // called from the worker thread
+    using ResultCallback = std::function<void(RevalidationResult result)>;
+
+    explicit DirectoryRevalidator(ResultCallback callback);
+    ~DirectoryRevalidator();
+
+    // disallow copies, the worker shares state with this
+    DirectoryRevalidator(const DirectoryRevalidator&) = delete;
+    DirectoryRevalidator& operator=(const DirectoryRevalidator&) = delete;
+
+    unsigned long Request(const fs::path& path, const std::vector<FileEntry>* shown, const DirectoryStamp* shownStamp);
+
+private:
+    // lives as long as any worker, so workers stuck on a dead mount can be left behind
+    struct Shared {
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        // only the latest request matters, older ones are replaced
+        bool pending = false;
+        fs::path pendingPath;
+        bool pendingShown = false;
+        std::vector<FileEntry> shownEntries;
+        bool pendingStamped = false;
+        DirectoryStamp shownStamp;
+        unsigned long generation = 0;
+        bool stopping = false;
+        int idleWorkers = 0; // workers waiting for a request, a busy (maybe stuck) one doesn't count
+
+        // held while reporting so the destructor can't clear the callback mid-call
+        std::mutex callbackMutex;
+        ResultCallback callback;
+    };
+
+    static void WorkerLoop(std::shared_ptr<Shared> shared);
+
+    std::shared_ptr<Shared> m_shared;
+};
+
+#endif // DIRECTORY_REVALIDATOR_H
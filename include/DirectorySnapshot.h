@@ -0,0 +1,118 @@
+/*
+ * Author: Mathew Lane
+ * Description: Declares the on-disk snapshot of recently browsed directory listings, stored flat so it can be mmap'd and read in place.
+ * Date: 2026-02-02
+ */
+
+#ifndef DIRECTORY_SNAPSHOT_H
+#define DIRECTORY_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include "FileManagerLogic.h"
+
+namespace fs = std::filesystem;
+
+// directory mtime, used to tell whether a stored listing is still current
+struct DirectoryStamp {
+    std::int64_t sec = 0;
+    std::int64_t nsec = 0;
+    bool operator==(const DirectoryStamp& other) const { return sec == other.sec && nsec == other.nsec; }
+    bool operator!=(const DirectoryStamp& other) const { return !(*this == other); }
+};
+
+class DirectorySnapshot {
+public:
+    static constexpr std::uint32_t VERSION = 3;
+    static constexpr std::size_t MAX_DIRECTORIES = 32;
+    // bigger listings aren't kept at all, and the file as a whole stays under the byte budget
+    static constexpr std::size_t MAX_ENTRIES_PER_LISTING = 20000;
+    static constexpr std::size_t MAX_SNAPSHOT_BYTES = 16 * 1024 * 1024;
+
+    DirectorySnapshot();
+    ~DirectorySnapshot();
+
+    // owns a mapping, so no copies
+    DirectorySnapshot(const DirectorySnapshot&) = delete;
+    DirectorySnapshot& operator=(const DirectorySnapshot&) = delete;
+
+    bool Load(const fs::path& file);
+    bool Save();
+
+    bool Lookup(const fs::path& dir, std::vector<FileEntry>& entries, DirectoryStamp& stamp);
+    void Store(const fs::path& dir, const DirectoryStamp& stamp, const std::vector<FileEntry>& entries);
+
+    static fs::path DefaultLocation();
+    static bool ReadStamp(const fs::path& dir, DirectoryStamp& stamp);
+
+private:
+    // on-disk layout: Header, DirRecord[dirCount], EntryRecord[entryCount], string pool
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t dirCount;
+        std::uint64_t entryCount;
+        std::uint64_t dirOffset;
+        std::uint64_t entryOffset;
+        std::uint64_t stringOffset;
+        std::uint64_t stringSize;
+    };
+
+    struct StringRef {
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::uint32_t reserved;
+    };
+
+    struct DirRecord {
+        StringRef path;
+        std::uint64_t firstEntry;
+        std::uint64_t entryCount;
+        std::int64_t mtimeSec;
+        std::int64_t mtimeNsec;
+        std::int64_t lastUsed;
+    };
+
+    struct EntryRecord {
+        StringRef name;
+        StringRef type;
+        StringRef size;
+        StringRef modified;
+        std::uint32_t isDirectory;
+        std::uint32_t reserved;
+    };
+
+    // listing stored or refreshed this session, not yet written out
+    struct Listing {
+        DirectoryStamp stamp;
+        std::int64_t lastUsed;
+        std::vector<FileEntry> entries;
+    };
+
+    static std::string Key(const fs::path& dir);
+    static std::int64_t Now();
+
+    void Unmap();
+    const DirRecord* FindMapped(const std::string& key) const;
+    std::string MappedString(const StringRef& ref) const;
+    std::size_t MappedBytes(const DirRecord& record) const;
+    void ReadMapped(const DirRecord& record, std::vector<FileEntry>& entries) const;
+
+    fs::path m_file;
+    const unsigned char* m_data;
+    std::size_t m_size;
+    const Header* m_header;
+    const DirRecord* m_dirs;
+    const EntryRecord* m_entries;
+
+    std::unordered_map<std::string, Listing> m_updated;
+    std::unordered_map<std::string, std::int64_t> m_touched;
+    std::unordered_set<std::string> m_dropped; // grew past the entry cap, the mapped copy is stale
+};
+
+#endif // DIRECTORY_SNAPSHOT_H
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <memory>
 
 namespace fs = std::filesystem;
 
@@ -20,8 +21,16 @@ struct FileEntry {
     std::string size;
     std::string modified; // for date
     bool isDirectory;
+
+    bool operator==(const FileEntry& other) const {
+        return name == other.name && type == other.type && size == other.size
+            && modified == other.modified && isDirectory == other.isDirectory;
+    }
 };
 
+class DirectorySnapshot;
+struct DirectoryStamp;
+
 class FileManagerLogic {
 public:
     enum class ClipboardOp { COPY, CUT, NONE };
@@ -37,11 +46,14 @@ public:
     void Cut(const fs::path& source);
     bool Paste(const fs::path& destination, bool overwriteConfirmed = false);
 
-    std::vector<FileEntry> GetDirectoryContents(const fs::path& path);
+    bool GetSnapshotContents(const fs::path& path, std::vector<FileEntry>& entries, DirectoryStamp& stamp);
+    void RecordContents(const fs::path& path, const DirectoryStamp& stamp, const std::vector<FileEntry>& entries);
+    static bool ListDirectory(const fs::path& path, std::vector<FileEntry>& entries, std::string& error);
     fs::path GetCurrentPath() const { return m_currentPath; }
     void SetCurrentPath(const fs::path& path) { m_currentPath = path; }
 
     static std::string FormatSize(uintmax_t size);
+    static std::string ExtensionLabel(const fs::path& path);
     std::string GetLastError() const { return m_lastError; }
     fs::path GetClipboardPath() const { return m_clipboardSource; }
 
@@ -50,6 +62,7 @@ private:
     fs::path m_clipboardSource;
     ClipboardOp m_lastOp;
     std::string m_lastError;
+    std::unique_ptr<DirectorySnapshot> m_snapshot;
 
     void SetError(const std::string& error) { m_lastError = error; }
 };
@@ -0,0 +1,98 @@
+/*
+ * Author: Mathew Lane
+ * Description: Declares the content-based file type detector that sniffs file headers against a compiled magic table on a worker pool.
+ * Date: 2026-02-02
+ */
+
+#ifndef FILE_TYPE_DETECTOR_H
+#define FILE_TYPE_DETECTOR_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace fs = std::filesystem;
+
+class FileTypeDetector {
+public:
+    // called from a worker thread when a requested row has been sniffed
+    using ResultCallback = std::function<void(unsigned long generation, long row, const std::string& type)>;
+
+    static constexpr std::size_t SNIFF_BYTES = 512;
+
+    explicit FileTypeDetector(ResultCallback callback, unsigned int workerCount = 0);
+    ~FileTypeDetector();
+
+    // disallow copies, the workers share state with this
+    FileTypeDetector(const FileTypeDetector&) = delete;
+    FileTypeDetector& operator=(const FileTypeDetector&) = delete;
+
+    unsigned long NewGeneration();
+    void Request(const fs::path& path, long row);
+    std::string Detect(const fs::path& path);
+
+    static std::string DetectFromBuffer(const unsigned char* data, std::size_t length, const std::string& extension);
+
+private:
+    // trie node of the compiled magic table, children are kept sorted by byte
+    struct Node {
+        std::vector<std::pair<unsigned char, int>> children;
+        int wildcard = -1;
+        int label = -1;
+    };
+
+    // identifies one version of a file on disk
+    struct CacheKey {
+        std::uint64_t device;
+        std::uint64_t inode;
+        std::int64_t mtimeSec;
+        std::int64_t mtimeNsec;
+        std::uint64_t size;
+        bool operator==(const CacheKey& other) const;
+    };
+
+    struct CacheKeyHash {
+        std::size_t operator()(const CacheKey& key) const;
+    };
+
+    struct Job {
+        unsigned long generation;
+        long row;
+        fs::path path;
+    };
+
+    // lives as long as the workers, so one stuck reading a dead mount can be detached at shutdown
+    struct Shared {
+        std::deque<Job> queue;
+        std::mutex queueMutex;
+        std::condition_variable queueCv;
+        unsigned long generation = 0;
+        bool stopping = false;
+
+        // held while reporting so the destructor can't clear the callback mid-call
+        std::mutex callbackMutex;
+        ResultCallback callback;
+
+        std::unordered_map<CacheKey, std::string, CacheKeyHash> cache;
+        std::mutex cacheMutex;
+    };
+
+    static const std::vector<Node>& Tree();
+    static std::vector<Node> CompileTree();
+    static std::string ClassifyUnknown(const unsigned char* data, std::size_t length);
+    static std::string Sniff(Shared& shared, const fs::path& path);
+
+    static void WorkerLoop(std::shared_ptr<Shared> shared);
+
+    std::shared_ptr<Shared> m_shared;
+};
+
+#endif // FILE_TYPE_DETECTOR_H
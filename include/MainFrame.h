@@ -9,7 +9,11 @@
 
 #include <wx/wx.h>
 #include <wx/listctrl.h>
+#include <wx/timer.h>
+#include <vector>
 #include "FileManagerLogic.h"
+#include "FileTypeDetector.h"
+#include "DirectoryRevalidator.h"
 
 class MainFrame : public wxFrame {
 public:
@@ -27,12 +31,18 @@ private:
         ID_COPY,
         ID_CUT,
         ID_PASTE,
-        ID_CREATE_FOLDER
+        ID_CREATE_FOLDER,
+        ID_TYPE_TIMER
     };
 
     void CreateControls();
-    void UpdateList();
+    void UpdateList(bool useSnapshot = true);
+    void PopulateList(const std::vector<FileEntry>& entries);
+    void OnDirectoryRevalidated(const RevalidationResult& result);
     void SetupMenuBar();
+    void RequestVisibleTypes();
+    void RequestType(long index);
+    void OnTypeDetected(unsigned long generation, long row, const std::string& type);
     
     // event handlers
     void OnExit(wxCommandEvent& event);
@@ -44,12 +54,27 @@ private:
     void OnCopy(wxCommandEvent& event);
     void OnCut(wxCommandEvent& event);
     void OnPaste(wxCommandEvent& event);
+    void OnItemSelected(wxListEvent& event);
+    void OnTypeTimer(wxTimerEvent& event);
 
     // UI components 
     wxListCtrl* m_fileList;
     wxTextCtrl* m_pathBar;
     FileManagerLogic m_logic;
 
+    // content sniffing for the Type column, only for rows the user can see
+    FileTypeDetector m_typeDetector;
+    unsigned long m_typeGeneration;
+    std::vector<bool> m_typeRequested;
+    wxTimer m_typeTimer;
+    long m_lastTopItem;
+    int m_lastPageCount; // a bigger window shows more rows without scrolling
+
+    // shows the last-known listing right away and refreshes it in the background
+    DirectoryRevalidator m_revalidator;
+    unsigned long m_listGeneration;
+    fs::path m_fallbackPath; // where to go back to if the folder we navigated to turns out not to exist
+
     // class handles own events
     wxDECLARE_EVENT_TABLE();
 };
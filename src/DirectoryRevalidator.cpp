@@ -0,0 +1,146 @@
+/*
+ * Author: Mathew Lane
+ * Description: Implements the workers that re-list the shown directory so slow filesystems never block the UI thread or later navigation.
+ * Date: 2026-02-02
+ */
+
+#include "DirectoryRevalidator.h"
+#include <thread>
+#include <sys/vfs.h>
+
+namespace {
+
+/*
+ * Function: IsRemoteFilesystem
+ * Description: checks whether a directory lives on a network or host-shared mount (NFS, SMB/CIFS, FUSE, WSL's 9p drives) where listing is slow
+ * Parameters: dir: directory to check
+ * Returns: true for remote filesystems, false for local ones or if it can't tell
+ */
+bool IsRemoteFilesystem(const fs::path& dir) {
+    struct statfs info;
+    if (statfs(dir.c_str(), &info) != 0) return false;
+
+    switch (static_cast<unsigned long>(info.f_type)) {
+        case 0x6969UL:     // NFS
+        case 0x517BUL:     // SMB
+        case 0xFF534D42UL: // CIFS
+        case 0xFE534D42UL: // SMB2
+        case 0x65735546UL: // FUSE (sshfs etc.)
+        case 0x01021997UL: // 9p, used for /mnt/c under WSL
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+/*
+ * Function: DirectoryRevalidator
+ * Description: constructor for DirectoryRevalidator, workers are started on demand by Request
+ * Parameters: callback: receives every result on a worker thread
+ * Returns: None
+ */
+DirectoryRevalidator::DirectoryRevalidator(ResultCallback callback)
+    : m_shared(std::make_shared<Shared>()) {
+    m_shared->callback = std::move(callback);
+}
+
+/*
+ * Function: ~DirectoryRevalidator
+ * Description: destructor for DirectoryRevalidator that stops the workers without waiting on them, since they may be stuck on a dead mount
+ * Parameters: None
+ * Returns: None
+ */
+DirectoryRevalidator::~DirectoryRevalidator() {
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        m_shared->stopping = true;
+        m_shared->pending = false;
+    }
+    m_shared->cv.notify_all();
+
+    // after this no worker can call back into an owner that's gone
+    std::lock_guard<std::mutex> lock(m_shared->callbackMutex);
+    m_shared->callback = nullptr;
+}
+
+/*
+ * Function: Request
+ * Description: asks a worker to re-list a directory, replacing any request not yet started and starting a worker if none is free
+ * Parameters: path: directory being shown, shown: the listing on screen, or nullptr to always report the new listing,
+ *             shownStamp: mtime the shown listing was taken at, or nullptr if unknown
+ * Returns: the generation to match against results
+ */
+unsigned long DirectoryRevalidator::Request(const fs::path& path, const std::vector<FileEntry>* shown, const DirectoryStamp* shownStamp) {
+    unsigned long generation;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        m_shared->pending = true;
+        m_shared->pendingPath = path;
+        m_shared->pendingShown = shown != nullptr;
+        m_shared->shownEntries = shown ? *shown : std::vector<FileEntry>();
+        m_shared->pendingStamped = shownStamp != nullptr;
+        m_shared->shownStamp = shownStamp ? *shownStamp : DirectoryStamp();
+        generation = ++m_shared->generation;
+
+        // if every worker is busy (possibly hung on a dead mount) start a fresh one so this request isn't stuck behind it
+        if (m_shared->idleWorkers == 0) {
+            std::thread(&DirectoryRevalidator::WorkerLoop, m_shared).detach();
+        }
+    }
+    m_shared->cv.notify_one();
+    return generation;
+}
+
+/*
+ * Function: WorkerLoop
+ * Description: takes the latest request, lists the directory (or trusts its mtime on a remote mount) and reports the new listing or that it matches what's shown
+ * Parameters: shared: state shared with the owner
+ * Returns: void
+ */
+void DirectoryRevalidator::WorkerLoop(std::shared_ptr<Shared> shared) {
+    while (true) {
+        RevalidationResult result;
+        bool compare;
+        std::vector<FileEntry> shown;
+        bool stamped;
+        DirectoryStamp shownStamp;
+        {
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            // one idle worker is enough, extras (e.g. one that came back from a slow mount) just exit
+            if (shared->idleWorkers > 0 && !shared->pending) return;
+
+            ++shared->idleWorkers;
+            shared->cv.wait(lock, [&shared] { return shared->stopping || shared->pending; });
+            --shared->idleWorkers;
+            if (shared->stopping) return;
+            shared->pending = false;
+            result.generation = shared->generation;
+            result.path = shared->pendingPath;
+            compare = shared->pendingShown;
+            shown.swap(shared->shownEntries);
+            stamped = shared->pendingStamped;
+            shownStamp = shared->shownStamp;
+        }
+
+        if (!DirectorySnapshot::ReadStamp(result.path, result.stamp)) {
+            result.missing = true;
+            result.error = "The directory could not be read.";
+        } else if (compare && stamped && result.stamp == shownStamp && IsRemoteFilesystem(result.path)) {
+            // on a slow mount an unchanged mtime is trusted: files may have grown, but no entries came or went
+            result.unchanged = true;
+        } else {
+            // locally always re-list, the directory mtime doesn't move when a file's size or date does.
+            // the stamp was taken first, so a change made mid-listing is caught next visit
+            FileManagerLogic::ListDirectory(result.path, result.entries, result.error);
+            if (compare && result.error.empty() && result.entries == shown) {
+                result.unchanged = true;
+                result.entries.clear();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(shared->callbackMutex);
+        if (shared->callback) shared->callback(std::move(result));
+    }
+}
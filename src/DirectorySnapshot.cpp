@@ -0,0 +1,413 @@
+/*
+ * Author: Mathew Lane
+ * Description: Implements loading the listing snapshot with mmap, looking listings up in place, and writing it back out atomically.
+ * Date: 2026-02-02
+ */
+
+#include "DirectorySnapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'F', 'M', 'S', 'N', 'A', 'P', '\0', '\0' };
+
+} // namespace
+
+/*
+ * Function: DirectorySnapshot
+ * Description: constructor for DirectorySnapshot, starts with nothing mapped
+ * Parameters: None
+ * Returns: None
+ */
+DirectorySnapshot::DirectorySnapshot()
+    : m_data(nullptr), m_size(0), m_header(nullptr), m_dirs(nullptr), m_entries(nullptr) {}
+
+/*
+ * Function: ~DirectorySnapshot
+ * Description: destructor for DirectorySnapshot that releases the mapping
+ * Parameters: None
+ * Returns: None
+ */
+DirectorySnapshot::~DirectorySnapshot() {
+    Unmap();
+}
+
+/*
+ * Function: Load
+ * Description: maps the snapshot file read-only and checks its header and directory table, ignoring it if anything is off
+ * Parameters: file: path to the snapshot file
+ * Returns: true if a usable snapshot was mapped
+ */
+bool DirectorySnapshot::Load(const fs::path& file) {
+    Unmap();
+    m_file = file;
+
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid without the descriptor
+    if (data == MAP_FAILED) return false;
+
+    m_data = static_cast<const unsigned char*>(data);
+    m_size = static_cast<std::size_t>(st.st_size);
+    m_header = reinterpret_cast<const Header*>(m_data);
+
+    // anything from an older version or a half-written file is simply dropped.
+    // each count is bounded by the space left before it's multiplied, so nothing here can wrap
+    const Header& h = *m_header;
+    bool valid = std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0
+        && h.version == VERSION
+        && h.dirOffset == sizeof(Header)
+        && h.dirCount <= (m_size - sizeof(Header)) / sizeof(DirRecord)
+        && h.entryOffset == h.dirOffset + static_cast<std::uint64_t>(h.dirCount) * sizeof(DirRecord)
+        && h.entryOffset <= m_size
+        && h.entryCount <= (m_size - h.entryOffset) / sizeof(EntryRecord)
+        && h.stringOffset == h.entryOffset + h.entryCount * sizeof(EntryRecord)
+        && h.stringOffset <= m_size
+        && h.stringSize == m_size - h.stringOffset;
+    if (!valid) {
+        Unmap();
+        return false;
+    }
+
+    m_dirs = reinterpret_cast<const DirRecord*>(m_data + h.dirOffset);
+    m_entries = reinterpret_cast<const EntryRecord*>(m_data + h.entryOffset);
+
+    for (std::uint32_t i = 0; i < h.dirCount; ++i) {
+        const DirRecord& dir = m_dirs[i];
+        if (dir.firstEntry > h.entryCount || dir.entryCount > h.entryCount - dir.firstEntry) {
+            Unmap();
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Function: Save
+ * Description: writes the most recently used listings that fit in MAX_SNAPSHOT_BYTES to a temp file and renames it over the snapshot
+ * Parameters: None
+ * Returns: true on success, false on failure
+ */
+bool DirectorySnapshot::Save() {
+    if (m_file.empty() || (m_updated.empty() && m_touched.empty() && m_dropped.empty())) return false;
+
+    // gather every known listing by key, session updates win over the mapped copy
+    struct Candidate {
+        std::string key;
+        std::int64_t lastUsed;
+        const Listing* listing;
+        const DirRecord* record;
+        std::size_t bytes;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto& [key, listing] : m_updated) {
+        std::size_t bytes = sizeof(DirRecord) + key.size();
+        for (const FileEntry& fe : listing.entries) {
+            bytes += sizeof(EntryRecord) + fe.name.size() + fe.type.size() + fe.size.size() + fe.modified.size();
+        }
+        candidates.push_back({ key, listing.lastUsed, &listing, nullptr, bytes });
+    }
+    if (m_header) {
+        for (std::uint32_t i = 0; i < m_header->dirCount; ++i) {
+            std::string key = MappedString(m_dirs[i].path);
+            if (m_updated.count(key) || m_dropped.count(key)) continue;
+            std::int64_t lastUsed = m_dirs[i].lastUsed;
+            auto touched = m_touched.find(key);
+            if (touched != m_touched.end()) lastUsed = std::max(lastUsed, touched->second);
+            candidates.push_back({ key, lastUsed, nullptr, &m_dirs[i], MappedBytes(m_dirs[i]) });
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.lastUsed > b.lastUsed; });
+
+    // most recent first, anything that would push the file past the budget is dropped
+    std::size_t budget = MAX_SNAPSHOT_BYTES - sizeof(Header);
+    std::vector<Candidate> kept;
+    for (const Candidate& c : candidates) {
+        if (kept.size() == MAX_DIRECTORIES) break;
+        if (c.bytes > budget) continue;
+        budget -= c.bytes;
+        kept.push_back(c);
+    }
+    candidates.swap(kept);
+
+    std::vector<DirRecord> dirs;
+    std::vector<EntryRecord> entries;
+    std::string strings;
+
+    auto addString = [&strings](const std::string& s) {
+        StringRef ref{ strings.size(), static_cast<std::uint32_t>(s.size()), 0 };
+        strings += s;
+        return ref;
+    };
+
+    for (const Candidate& c : candidates) {
+        std::vector<FileEntry> listed;
+        DirRecord dir{};
+        dir.path = addString(c.key);
+        dir.firstEntry = entries.size();
+        dir.lastUsed = c.lastUsed;
+
+        if (c.listing) {
+            dir.mtimeSec = c.listing->stamp.sec;
+            dir.mtimeNsec = c.listing->stamp.nsec;
+        } else {
+            dir.mtimeSec = c.record->mtimeSec;
+            dir.mtimeNsec = c.record->mtimeNsec;
+            ReadMapped(*c.record, listed);
+        }
+
+        for (const FileEntry& fe : c.listing ? c.listing->entries : listed) {
+            EntryRecord entry{};
+            entry.name = addString(fe.name);
+            entry.type = addString(fe.type);
+            entry.size = addString(fe.size);
+            entry.modified = addString(fe.modified);
+            entry.isDirectory = fe.isDirectory ? 1 : 0;
+            entries.push_back(entry);
+        }
+        dir.entryCount = entries.size() - dir.firstEntry;
+        dirs.push_back(dir);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = VERSION;
+    header.dirCount = static_cast<std::uint32_t>(dirs.size());
+    header.entryCount = entries.size();
+    header.dirOffset = sizeof(Header);
+    header.entryOffset = header.dirOffset + dirs.size() * sizeof(DirRecord);
+    header.stringOffset = header.entryOffset + entries.size() * sizeof(EntryRecord);
+    header.stringSize = strings.size();
+
+    try {
+        fs::create_directories(m_file.parent_path());
+        // pid in the name so two instances exiting together don't write into the same temp file
+        fs::path temp = m_file;
+        temp += "." + std::to_string(getpid()) + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(dirs.data()), dirs.size() * sizeof(DirRecord));
+            out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(EntryRecord));
+            out.write(strings.data(), strings.size());
+            if (!out) {
+                out.close();
+                fs::remove(temp);
+                return false;
+            }
+        }
+        // rename keeps readers from ever seeing a partial file
+        fs::rename(temp, m_file);
+    } catch (const fs::filesystem_error&) {
+        return false;
+    }
+
+    m_updated.clear();
+    m_touched.clear();
+    m_dropped.clear();
+    return Load(m_file);
+}
+
+/*
+ * Function: Lookup
+ * Description: finds the last-known listing for a directory, from this session or the mapped snapshot
+ * Parameters: dir: directory to look up, entries: filled with the listing, stamp: filled with the mtime it was taken at
+ * Returns: true if a listing was found
+ */
+bool DirectorySnapshot::Lookup(const fs::path& dir, std::vector<FileEntry>& entries, DirectoryStamp& stamp) {
+    std::string key = Key(dir);
+    if (m_dropped.count(key)) return false;
+
+    auto updated = m_updated.find(key);
+    if (updated != m_updated.end()) {
+        updated->second.lastUsed = Now();
+        entries = updated->second.entries;
+        stamp = updated->second.stamp;
+        return true;
+    }
+
+    const DirRecord* record = FindMapped(key);
+    if (!record) return false;
+
+    m_touched[key] = Now();
+    stamp.sec = record->mtimeSec;
+    stamp.nsec = record->mtimeNsec;
+    ReadMapped(*record, entries);
+    return true;
+}
+
+/*
+ * Function: Store
+ * Description: records a fresh listing for a directory to be written out on the next save, unless it has more than MAX_ENTRIES_PER_LISTING entries
+ * Parameters: dir: directory listed, stamp: its mtime before listing, entries: the listing
+ * Returns: void
+ */
+void DirectorySnapshot::Store(const fs::path& dir, const DirectoryStamp& stamp, const std::vector<FileEntry>& entries) {
+    std::string key = Key(dir);
+    m_touched.erase(key);
+
+    // huge folders cost more to snapshot than to list, forget them entirely
+    if (entries.size() > MAX_ENTRIES_PER_LISTING) {
+        m_updated.erase(key);
+        m_dropped.insert(key);
+        return;
+    }
+    m_dropped.erase(key);
+    m_updated[key] = Listing{ stamp, Now(), entries };
+
+    // keep the session overlay bounded too, dropping the oldest
+    if (m_updated.size() > MAX_DIRECTORIES) {
+        auto oldest = std::min_element(m_updated.begin(), m_updated.end(),
+            [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+        m_updated.erase(oldest);
+    }
+}
+
+/*
+ * Function: DefaultLocation
+ * Description: picks the snapshot path under $XDG_CACHE_HOME, or ~/.cache if that isn't set
+ * Parameters: None
+ * Returns: the snapshot file path, empty if no home directory is known
+ */
+fs::path DirectorySnapshot::DefaultLocation() {
+    const char* cache = std::getenv("XDG_CACHE_HOME");
+    if (cache && *cache) return fs::path(cache) / "filemanager" / "snapshot.bin";
+
+    const char* home = std::getenv("HOME");
+    if (home && *home) return fs::path(home) / ".cache" / "filemanager" / "snapshot.bin";
+    return fs::path();
+}
+
+/*
+ * Function: ReadStamp
+ * Description: reads a directory's mtime
+ * Parameters: dir: directory to stat, stamp: filled with the mtime
+ * Returns: true on success, false if the directory couldn't be read
+ */
+bool DirectorySnapshot::ReadStamp(const fs::path& dir, DirectoryStamp& stamp) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    stamp.sec = static_cast<std::int64_t>(st.st_mtim.tv_sec);
+    stamp.nsec = static_cast<std::int64_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+/*
+ * Function: Key
+ * Description: normalizes a directory path so the same folder typed differently shares one entry
+ * Parameters: dir: directory path
+ * Returns: the normalized path string
+ */
+std::string DirectorySnapshot::Key(const fs::path& dir) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(dir, ec);
+    std::string key = (ec ? dir : absolute).lexically_normal().string();
+    while (key.size() > 1 && key.back() == '/') key.pop_back();
+    return key;
+}
+
+/*
+ * Function: Now
+ * Description: current wall clock time in milliseconds, for recency ordering (seconds tie too often within one session)
+ * Parameters: None
+ * Returns: milliseconds since the epoch
+ */
+std::int64_t DirectorySnapshot::Now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Function: Unmap
+ * Description: releases the current mapping, if any
+ * Parameters: None
+ * Returns: void
+ */
+void DirectorySnapshot::Unmap() {
+    if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_dirs = nullptr;
+    m_entries = nullptr;
+}
+
+/*
+ * Function: FindMapped
+ * Description: scans the mapped directory table for a key, it's capped at MAX_DIRECTORIES so a scan is fine
+ * Parameters: key: normalized directory path
+ * Returns: the matching record, or nullptr
+ */
+const DirectorySnapshot::DirRecord* DirectorySnapshot::FindMapped(const std::string& key) const {
+    if (!m_header) return nullptr;
+    for (std::uint32_t i = 0; i < m_header->dirCount; ++i) {
+        const StringRef& ref = m_dirs[i].path;
+        if (ref.length == key.size() && MappedString(ref) == key) return &m_dirs[i];
+    }
+    return nullptr;
+}
+
+/*
+ * Function: MappedString
+ * Description: reads a string out of the mapped pool, returning empty for out of range references
+ * Parameters: ref: offset and length in the pool
+ * Returns: the string
+ */
+std::string DirectorySnapshot::MappedString(const StringRef& ref) const {
+    if (ref.offset > m_header->stringSize || ref.length > m_header->stringSize - ref.offset) return std::string();
+    return std::string(reinterpret_cast<const char*>(m_data + m_header->stringOffset + ref.offset), ref.length);
+}
+
+/*
+ * Function: MappedBytes
+ * Description: works out how many bytes a mapped directory record takes in the file, without copying its strings
+ * Parameters: record: the directory record
+ * Returns: size in bytes of the record, its entries and their strings
+ */
+std::size_t DirectorySnapshot::MappedBytes(const DirRecord& record) const {
+    std::size_t bytes = sizeof(DirRecord) + record.path.length;
+    for (std::uint64_t i = 0; i < record.entryCount; ++i) {
+        const EntryRecord& e = m_entries[record.firstEntry + i];
+        bytes += sizeof(EntryRecord) + e.name.length + e.type.length + e.size.length + e.modified.length;
+    }
+    return bytes;
+}
+
+/*
+ * Function: ReadMapped
+ * Description: builds FileEntry rows for one mapped directory record
+ * Parameters: record: the directory record, entries: filled with its rows
+ * Returns: void
+ */
+void DirectorySnapshot::ReadMapped(const DirRecord& record, std::vector<FileEntry>& entries) const {
+    entries.clear();
+    entries.reserve(record.entryCount);
+    for (std::uint64_t i = 0; i < record.entryCount; ++i) {
+        const EntryRecord& e = m_entries[record.firstEntry + i];
+        FileEntry fe;
+        fe.name = MappedString(e.name);
+        fe.type = MappedString(e.type);
+        fe.size = MappedString(e.size);
+        fe.modified = MappedString(e.modified);
+        fe.isDirectory = e.isDirectory != 0;
+        entries.push_back(fe);
+    }
+}
@@ -5,27 +5,32 @@
  */
 
 #include "FileManagerLogic.h"
+#include "DirectorySnapshot.h"
 #include <iomanip>
 #include <sstream>
 #include <chrono>
+#include <cctype>
 
 /*
  * Function: FileManagerLogic
- * Description: constructor for FileManagerLogic class that initializes the cd and sets the last operation to NONE.
+ * Description: constructor for FileManagerLogic class that initializes the cd, sets the last operation to NONE and maps the listing snapshot.
  * Parameters: None
  * Returns: None
  */
-FileManagerLogic::FileManagerLogic() : m_lastOp(ClipboardOp::NONE) {
+FileManagerLogic::FileManagerLogic() : m_lastOp(ClipboardOp::NONE), m_snapshot(new DirectorySnapshot()) {
     m_currentPath = fs::current_path();
+    m_snapshot->Load(DirectorySnapshot::DefaultLocation());
 }
 
 /*
  * Function: ~FileManagerLogic
- * Description: destructor for FileManagerLogic class
+ * Description: destructor for FileManagerLogic class that writes the listing snapshot back out for the next launch
  * Parameters: None
  * Returns: None
  */
-FileManagerLogic::~FileManagerLogic() {}
+FileManagerLogic::~FileManagerLogic() {
+    m_snapshot->Save();
+}
 
 /*
  * Function: CreateFolder
@@ -152,42 +157,85 @@ bool FileManagerLogic::Paste(const fs::path& destination, bool overwriteConfirme
 }
 
 /*
- * Function: GetDirectoryContents
- * Description: returns a vector of FileEntry objects for each item in the specified directory
- * Parameters: path: the path of the directory to list contents of
- * Returns: vector of FileEntry objects representing each item in the cd
+ * Function: GetSnapshotContents
+ * Description: gets the last-known listing of a directory without touching the filesystem
+ * Parameters: path: directory to look up, entries: filled with the listing, stamp: filled with the mtime it was taken at
+ * Returns: true if a listing was stored for the directory
  */
-std::vector<FileEntry> FileManagerLogic::GetDirectoryContents(const fs::path& path) {
-    std::vector<FileEntry> entries;
-    try {
-        for (const auto& entry : fs::directory_iterator(path)) {
-            FileEntry fe;
-            fe.name = entry.path().filename().string();
-            fe.isDirectory = entry.is_directory();
-            fe.type = fe.isDirectory ? "Folder" : entry.path().extension().string();
-            
-            if (!fe.isDirectory) {
-                fe.size = FormatSize(fs::file_size(entry));
-            } else {
-                fe.size = "--";
-            }
+bool FileManagerLogic::GetSnapshotContents(const fs::path& path, std::vector<FileEntry>& entries, DirectoryStamp& stamp) {
+    return m_snapshot->Lookup(path, entries, stamp);
+}
+
+/*
+ * Function: RecordContents
+ * Description: stores a listing produced elsewhere (e.g. the background revalidator) in the snapshot
+ * Parameters: path: directory listed, stamp: its mtime before listing, entries: the listing
+ * Returns: void
+ */
+void FileManagerLogic::RecordContents(const fs::path& path, const DirectoryStamp& stamp, const std::vector<FileEntry>& entries) {
+    m_snapshot->Store(path, stamp, entries);
+}
+
+/*
+ * Function: ListDirectory
+ * Description: reads the items of a directory into FileEntry objects, safe to call from any thread
+ * Parameters: path: directory to list, entries: filled with the items (partial if reading stopped early), error: set on failure
+ * Returns: true on success, false if the directory couldn't be fully read
+ */
+bool FileManagerLogic::ListDirectory(const fs::path& path, std::vector<FileEntry>& entries, std::string& error) {
+    entries.clear();
+
+    std::error_code iterError;
+    fs::directory_iterator it(path, iterError);
+    if (iterError) {
+        error = iterError.message();
+        return false;
+    }
 
-            auto ftime = fs::last_write_time(entry);
+    for (fs::directory_iterator end; it != end; it.increment(iterError)) {
+        if (iterError) break;
+        const fs::directory_entry& entry = *it;
+
+        // one bad entry (e.g. a dangling symlink) is shown with blanks rather than failing the whole folder
+        std::error_code entryError;
+        FileEntry fe;
+        fe.name = entry.path().filename().string();
+        fe.isDirectory = entry.is_directory(entryError);
+        fe.type = fe.isDirectory ? "Folder" : ExtensionLabel(entry.path());
+        
+        if (!fe.isDirectory) {
+            uintmax_t size = entry.file_size(entryError);
+            fe.size = entryError ? "--" : FormatSize(size);
+        } else {
+            fe.size = "--";
+        }
+
+        auto ftime = entry.last_write_time(entryError);
+        if (entryError) {
+            fe.modified = "--";
+        } else {
             auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
                 ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
             );
             std::time_t c_ftime = std::chrono::system_clock::to_time_t(sctp);
             
+            // localtime_r since this also runs on the revalidation thread
+            std::tm local{};
+            localtime_r(&c_ftime, &local);
             std::stringstream ss;
-            ss << std::put_time(std::localtime(&c_ftime), "%Y-%m-%d %H:%M");
+            ss << std::put_time(&local, "%Y-%m-%d %H:%M");
             fe.modified = ss.str();
-
-            entries.push_back(fe);
         }
-    } catch (const fs::filesystem_error& e) {
-        SetError(e.what());
+
+        entries.push_back(fe);
+    }
+
+    // what was read before the failure is kept for the caller to show
+    if (iterError) {
+        error = iterError.message();
+        return false;
     }
-    return entries;
+    return true;
 }
 
 /*
@@ -207,3 +255,20 @@ std::string FileManagerLogic::FormatSize(uintmax_t size) {
     else out << size / (1024.0 * 1024.0 * 1024.0) << " GB";
     return out.str();
 }
+
+/*
+ * Function: ExtensionLabel
+ * Description: builds the Type column label from a file's extension, e.g. "notes.txt" gives "TXT File"
+ * Parameters: path: the file path
+ * Returns: the label, or "File" when there is no extension
+ */
+std::string FileManagerLogic::ExtensionLabel(const fs::path& path) {
+    std::string extension = path.extension().string();
+    if (extension.size() <= 1) return "File";
+
+    std::string label;
+    for (std::size_t i = 1; i < extension.size(); ++i) {
+        label += static_cast<char>(std::toupper(static_cast<unsigned char>(extension[i])));
+    }
+    return label + " File";
+}
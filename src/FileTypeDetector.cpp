@@ -0,0 +1,431 @@
+/*
+ * Author: Mathew Lane
+ * Description: Implements header sniffing against a magic signature trie, a small worker pool for visible rows, and an inode+mtime result cache.
+ * Date: 2026-02-02
+ */
+
+#include "FileTypeDetector.h"
+#include "FileManagerLogic.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+
+namespace {
+
+bool VerifyBmp(const unsigned char* data, std::size_t length);
+bool VerifyPe(const unsigned char* data, std::size_t length);
+
+// weak signatures are short enough to show up in ordinary text, so they never override an extension.
+// container signatures (zip, ole, iso media) are shared by many formats, so an extension from their family wins
+enum class Strength { STRONG, WEAK, CONTAINER };
+
+// hex bytes separated by spaces, "??" matches any byte; verify (if set) must also pass for a match.
+// family lists the space-separated extensions a container signature defers to
+struct MagicSignature {
+    std::size_t offset;
+    const char* pattern;
+    const char* label;
+    Strength strength;
+    bool (*verify)(const unsigned char* data, std::size_t length);
+    const char* family;
+};
+
+const char ZIP_FAMILY[] = " docx xlsx pptx docm xlsm pptm odt ods odp odg jar war ear aar apk aab ipa epub xpi vsix whl nupkg kmz 3mf cbz ";
+const char OLE_FAMILY[] = " doc xls ppt msi msg vsd pub dot xlt pot ";
+const char ISO_MEDIA_FAMILY[] = " mp4 m4v m4a m4b mov heic heif avif 3gp 3g2 f4v ";
+
+const MagicSignature MAGIC_TABLE[] = {
+    { 0,   "89 50 4E 47 0D 0A 1A 0A",             "PNG Image",          Strength::STRONG, nullptr, nullptr },
+    { 0,   "FF D8 FF",                            "JPEG Image",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "47 49 46 38 37 61",                   "GIF Image",          Strength::STRONG, nullptr, nullptr },
+    { 0,   "47 49 46 38 39 61",                   "GIF Image",          Strength::STRONG, nullptr, nullptr },
+    { 0,   "42 4D",                               "BMP Image",          Strength::STRONG, VerifyBmp, nullptr },
+    { 0,   "49 49 2A 00",                         "TIFF Image",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "4D 4D 00 2A",                         "TIFF Image",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "00 00 01 00",                         "Icon Image",         Strength::WEAK,   nullptr, nullptr },
+    { 0,   "52 49 46 46 ?? ?? ?? ?? 57 45 42 50", "WebP Image",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "52 49 46 46 ?? ?? ?? ?? 57 41 56 45", "WAV Audio",          Strength::STRONG, nullptr, nullptr },
+    { 0,   "52 49 46 46 ?? ?? ?? ?? 41 56 49 20", "AVI Video",          Strength::STRONG, nullptr, nullptr },
+    { 0,   "49 44 33",                            "MP3 Audio",          Strength::WEAK,   nullptr, nullptr },
+    { 0,   "FF FB",                               "MP3 Audio",          Strength::WEAK,   nullptr, nullptr },
+    { 0,   "66 4C 61 43",                         "FLAC Audio",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "4F 67 67 53",                         "Ogg Media",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70",                         "MP4 Media",          Strength::CONTAINER, nullptr, ISO_MEDIA_FAMILY },
+    { 4,   "66 74 79 70 71 74 20 20",             "QuickTime Video",    Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 69 73 6F 6D",             "MP4 Video",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 6D 70 34 31",             "MP4 Video",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 6D 70 34 32",             "MP4 Video",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 61 76 63 31",             "MP4 Video",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 4D 34 56 20",             "MP4 Video",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 4D 34 41 20",             "M4A Audio",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 4D 34 42 20",             "M4B Audiobook",      Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 68 65 69 63",             "HEIC Image",         Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 68 65 69 78",             "HEIC Image",         Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 6D 69 66 31",             "HEIF Image",         Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 61 76 69 66",             "AVIF Image",         Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 33 67 70",                "3GP Video",          Strength::STRONG, nullptr, nullptr },
+    { 4,   "66 74 79 70 33 67 32",                "3GP Video",          Strength::STRONG, nullptr, nullptr },
+    { 0,   "1A 45 DF A3",                         "Matroska Video",     Strength::STRONG, nullptr, nullptr },
+    { 0,   "25 50 44 46 2D",                      "PDF Document",       Strength::STRONG, nullptr, nullptr },
+    { 0,   "50 4B 03 04",                         "ZIP Archive",        Strength::CONTAINER, nullptr, ZIP_FAMILY },
+    { 0,   "50 4B 05 06",                         "ZIP Archive",        Strength::CONTAINER, nullptr, ZIP_FAMILY },
+    { 0,   "1F 8B 08",                            "GZIP Archive",       Strength::STRONG, nullptr, nullptr },
+    { 0,   "42 5A 68",                            "BZIP2 Archive",      Strength::STRONG, nullptr, nullptr },
+    { 0,   "FD 37 7A 58 5A 00",                   "XZ Archive",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "28 B5 2F FD",                         "Zstandard Archive",  Strength::STRONG, nullptr, nullptr },
+    { 0,   "37 7A BC AF 27 1C",                   "7-Zip Archive",      Strength::STRONG, nullptr, nullptr },
+    { 0,   "52 61 72 21 1A 07",                   "RAR Archive",        Strength::STRONG, nullptr, nullptr },
+    { 257, "75 73 74 61 72",                      "TAR Archive",        Strength::STRONG, nullptr, nullptr },
+    { 0,   "7F 45 4C 46",                         "ELF Executable",     Strength::STRONG, nullptr, nullptr },
+    { 0,   "4D 5A",                               "Windows Executable", Strength::STRONG, VerifyPe, nullptr },
+    { 0,   "CA FE BA BE",                         "Java Class",         Strength::STRONG, nullptr, nullptr },
+    { 0,   "00 61 73 6D",                         "WebAssembly Module", Strength::STRONG, nullptr, nullptr },
+    { 0,   "53 51 4C 69 74 65 20 66 6F 72 6D 61 74 20 33 00", "SQLite Database", Strength::STRONG, nullptr, nullptr },
+    { 0,   "D0 CF 11 E0 A1 B1 1A E1",             "Office Document",    Strength::CONTAINER, nullptr, OLE_FAMILY },
+    { 0,   "23 21",                               "Script File",        Strength::WEAK,   nullptr, nullptr },
+    { 0,   "3C 3F 78 6D 6C",                      "XML Document",       Strength::WEAK,   nullptr, nullptr },
+    { 0,   "EF BB BF",                            "Text File",          Strength::WEAK,   nullptr, nullptr },
+    { 0,   "FF FE",                               "UTF-16 Text File",   Strength::WEAK,   nullptr, nullptr },
+    { 0,   "FE FF",                               "UTF-16 Text File",   Strength::WEAK,   nullptr, nullptr },
+};
+
+constexpr std::size_t MAGIC_COUNT = sizeof(MAGIC_TABLE) / sizeof(MAGIC_TABLE[0]);
+
+// cap the cache so long sessions over huge trees don't grow without bound
+constexpr std::size_t MAX_CACHE_ENTRIES = 200000;
+
+std::uint32_t ReadLE32(const unsigned char* p) {
+    return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8
+        | static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+// "BM" alone is too common, also require zeroed reserved fields and a known DIB header size
+bool VerifyBmp(const unsigned char* data, std::size_t length) {
+    if (length < 18 || ReadLE32(data + 6) != 0) return false;
+    std::uint32_t dibSize = ReadLE32(data + 14);
+    return dibSize == 12 || dibSize == 40 || dibSize == 52 || dibSize == 56
+        || dibSize == 64 || dibSize == 108 || dibSize == 124;
+}
+
+// "MZ" only counts if e_lfanew points at a "PE\0\0" header inside what we read
+bool VerifyPe(const unsigned char* data, std::size_t length) {
+    if (length < 0x40) return false;
+    std::uint32_t peOffset = ReadLE32(data + 0x3C);
+    if (peOffset < 0x40 || peOffset > length - 4) return false;
+    return data[peOffset] == 'P' && data[peOffset + 1] == 'E' && data[peOffset + 2] == 0 && data[peOffset + 3] == 0;
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+} // namespace
+
+/*
+ * Function: FileTypeDetector
+ * Description: constructor for FileTypeDetector that starts the worker pool
+ * Parameters: callback: receives results on a worker thread, workerCount: number of workers (0 picks from hardware)
+ * Returns: None
+ */
+FileTypeDetector::FileTypeDetector(ResultCallback callback, unsigned int workerCount)
+    : m_shared(std::make_shared<Shared>()) {
+    m_shared->callback = std::move(callback);
+    if (workerCount == 0) {
+        workerCount = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+    }
+
+    // compile the table before any worker can race on it
+    Tree();
+
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        std::thread(&FileTypeDetector::WorkerLoop, m_shared).detach();
+    }
+}
+
+/*
+ * Function: ~FileTypeDetector
+ * Description: destructor for FileTypeDetector that drops queued work and stops the workers without waiting on a slow read
+ * Parameters: None
+ * Returns: None
+ */
+FileTypeDetector::~FileTypeDetector() {
+    {
+        std::lock_guard<std::mutex> lock(m_shared->queueMutex);
+        m_shared->stopping = true;
+        m_shared->queue.clear();
+    }
+    m_shared->queueCv.notify_all();
+
+    // after this no worker can call back into an owner that's gone
+    std::lock_guard<std::mutex> lock(m_shared->callbackMutex);
+    m_shared->callback = nullptr;
+}
+
+/*
+ * Function: NewGeneration
+ * Description: starts a new batch of requests (e.g. after changing directory) and discards anything still queued from the old one
+ * Parameters: None
+ * Returns: the generation number to match against results
+ */
+unsigned long FileTypeDetector::NewGeneration() {
+    std::lock_guard<std::mutex> lock(m_shared->queueMutex);
+    m_shared->queue.clear();
+    return ++m_shared->generation;
+}
+
+/*
+ * Function: Request
+ * Description: queues a file to be sniffed for the given list row in the current generation
+ * Parameters: path: file to sniff, row: list row the result belongs to
+ * Returns: void
+ */
+void FileTypeDetector::Request(const fs::path& path, long row) {
+    {
+        std::lock_guard<std::mutex> lock(m_shared->queueMutex);
+        m_shared->queue.push_back({ m_shared->generation, row, path });
+    }
+    m_shared->queueCv.notify_one();
+}
+
+/*
+ * Function: Detect
+ * Description: works out the type of a file on the calling thread, sharing the workers' cache
+ * Parameters: path: the file to inspect
+ * Returns: a display string for the Type column
+ */
+std::string FileTypeDetector::Detect(const fs::path& path) {
+    return Sniff(*m_shared, path);
+}
+
+/*
+ * Function: Sniff
+ * Description: works out the type of a file from its header, using the cache when the file is unchanged
+ * Parameters: shared: state holding the cache, path: the file to inspect
+ * Returns: a display string for the Type column
+ */
+std::string FileTypeDetector::Sniff(Shared& shared, const fs::path& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return FileManagerLogic::ExtensionLabel(path);
+    }
+
+    CacheKey key{ static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino),
+                  static_cast<std::int64_t>(st.st_mtim.tv_sec), static_cast<std::int64_t>(st.st_mtim.tv_nsec),
+                  static_cast<std::uint64_t>(st.st_size) };
+    {
+        std::lock_guard<std::mutex> lock(shared.cacheMutex);
+        auto it = shared.cache.find(key);
+        if (it != shared.cache.end()) return it->second;
+    }
+
+    unsigned char buffer[SNIFF_BYTES];
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        // unreadable, fall back to what the name says; not cached since a chmod doesn't change the key
+        return FileManagerLogic::ExtensionLabel(path);
+    }
+    file.read(reinterpret_cast<char*>(buffer), sizeof(buffer));
+    std::size_t length = static_cast<std::size_t>(file.gcount());
+
+    std::string type;
+    std::string extension = path.extension().string();
+    if (!extension.empty()) extension.erase(0, 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (length == 0) {
+        type = "Empty File";
+    } else {
+        type = DetectFromBuffer(buffer, length, extension);
+        // unknown content keeps the extension when there is one
+        if (type.empty() && !extension.empty()) type = FileManagerLogic::ExtensionLabel(path);
+        if (type.empty()) type = ClassifyUnknown(buffer, length);
+    }
+
+    std::lock_guard<std::mutex> lock(shared.cacheMutex);
+    if (shared.cache.size() >= MAX_CACHE_ENTRIES) shared.cache.clear();
+    shared.cache.emplace(key, type);
+    return type;
+}
+
+/*
+ * Function: DetectFromBuffer
+ * Description: walks the magic trie over a file header and picks the deepest (most specific) match that passes its checks
+ * Parameters: data: start of the header, length: number of valid bytes, extension: lowercase extension without the dot, empty if none
+ * Returns: the matched label, or an empty string if nothing matched (or the extension is the better answer)
+ */
+std::string FileTypeDetector::DetectFromBuffer(const unsigned char* data, std::size_t length, const std::string& extension) {
+    const std::vector<Node>& tree = Tree();
+    std::vector<std::pair<std::size_t, int>> matches; // (depth, label)
+
+    // depth-first over (node, depth); only wildcard edges ever branch so the stack stays tiny
+    std::vector<std::pair<int, std::size_t>> stack{ { 0, 0 } };
+    while (!stack.empty()) {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+        const Node& node = tree[index];
+
+        if (node.label != -1) matches.push_back({ depth, node.label });
+        if (depth >= length) continue;
+
+        if (node.wildcard != -1) stack.push_back({ node.wildcard, depth + 1 });
+
+        auto it = std::lower_bound(node.children.begin(), node.children.end(), data[depth],
+            [](const std::pair<unsigned char, int>& child, unsigned char byte) { return child.first < byte; });
+        if (it != node.children.end() && it->first == data[depth]) {
+            stack.push_back({ it->second, depth + 1 });
+        }
+    }
+
+    // deepest first, falling back to shorter matches when a check rejects it
+    std::sort(matches.begin(), matches.end(),
+        [](const std::pair<std::size_t, int>& a, const std::pair<std::size_t, int>& b) { return a.first > b.first; });
+    for (const auto& match : matches) {
+        const MagicSignature& magic = MAGIC_TABLE[match.second];
+        if (magic.strength == Strength::WEAK && !extension.empty()) continue;
+        if (magic.strength == Strength::CONTAINER && !extension.empty()
+            && std::strstr(magic.family, (" " + extension + " ").c_str())) continue;
+        if (magic.verify && !magic.verify(data, length)) continue;
+        return magic.label;
+    }
+    return std::string();
+}
+
+/*
+ * Function: Tree
+ * Description: returns the compiled magic trie, building it once on first use
+ * Parameters: None
+ * Returns: reference to the trie nodes, root at index 0
+ */
+const std::vector<FileTypeDetector::Node>& FileTypeDetector::Tree() {
+    // never freed, detached workers may still be reading it while statics are torn down at exit
+    static const std::vector<Node>* tree = new std::vector<Node>(CompileTree());
+    return *tree;
+}
+
+/*
+ * Function: CompileTree
+ * Description: turns MAGIC_TABLE into a byte trie, with offsets expanded to leading wildcard edges
+ * Parameters: None
+ * Returns: the trie nodes, root at index 0
+ */
+std::vector<FileTypeDetector::Node> FileTypeDetector::CompileTree() {
+    std::vector<Node> tree(1);
+
+    for (std::size_t sig = 0; sig < MAGIC_COUNT; ++sig) {
+        const MagicSignature& magic = MAGIC_TABLE[sig];
+        int current = 0;
+
+        for (std::size_t i = 0; i < magic.offset; ++i) {
+            if (tree[current].wildcard == -1) {
+                tree[current].wildcard = static_cast<int>(tree.size());
+                tree.emplace_back();
+            }
+            current = tree[current].wildcard;
+        }
+
+        for (const char* p = magic.pattern; *p; ) {
+            if (*p == ' ') { ++p; continue; }
+
+            if (p[0] == '?' && p[1] == '?') {
+                if (tree[current].wildcard == -1) {
+                    tree[current].wildcard = static_cast<int>(tree.size());
+                    tree.emplace_back();
+                }
+                current = tree[current].wildcard;
+            } else {
+                unsigned char byte = static_cast<unsigned char>(HexValue(p[0]) * 16 + HexValue(p[1]));
+                auto& children = tree[current].children;
+                auto it = std::lower_bound(children.begin(), children.end(), byte,
+                    [](const std::pair<unsigned char, int>& child, unsigned char b) { return child.first < b; });
+                if (it != children.end() && it->first == byte) {
+                    current = it->second;
+                } else {
+                    int next = static_cast<int>(tree.size());
+                    children.insert(it, { byte, next });
+                    tree.emplace_back(); // may reallocate, so 'children' is not used past here
+                    current = next;
+                }
+            }
+            p += 2;
+        }
+
+        // first entry wins if two signatures are identical
+        if (tree[current].label == -1) tree[current].label = static_cast<int>(sig);
+    }
+    return tree;
+}
+
+/*
+ * Function: ClassifyUnknown
+ * Description: guesses between text and binary for headers with no magic match
+ * Parameters: data: start of the header, length: number of valid bytes
+ * Returns: "Text File" or "Binary File"
+ */
+std::string FileTypeDetector::ClassifyUnknown(const unsigned char* data, std::size_t length) {
+    std::size_t control = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+        unsigned char c = data[i];
+        if (c == 0) return "Binary File";
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f' && c != 0x1B) ++control;
+    }
+    // a few stray control characters still reads as text, lots of them doesn't
+    return control * 10 > length ? "Binary File" : "Text File";
+}
+
+/*
+ * Function: WorkerLoop
+ * Description: pulls jobs off the queue, skips ones from old generations and reports results through the callback
+ * Parameters: shared: state shared with the owner
+ * Returns: void
+ */
+void FileTypeDetector::WorkerLoop(std::shared_ptr<Shared> shared) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(shared->queueMutex);
+            shared->queueCv.wait(lock, [&shared] { return shared->stopping || !shared->queue.empty(); });
+            if (shared->stopping) return;
+            job = std::move(shared->queue.front());
+            shared->queue.pop_front();
+            if (job.generation != shared->generation) continue;
+        }
+
+        std::string type = Sniff(*shared, job.path);
+
+        std::lock_guard<std::mutex> lock(shared->callbackMutex);
+        if (shared->callback) shared->callback(job.generation, job.row, type);
+    }
+}
+
+/*
+ * Function: operator==
+ * Description: compares two cache keys field by field
+ * Parameters: other: key to compare with
+ * Returns: true if both describe the same file version
+ */
+bool FileTypeDetector::CacheKey::operator==(const CacheKey& other) const {
+    return device == other.device && inode == other.inode && mtimeSec == other.mtimeSec
+        && mtimeNsec == other.mtimeNsec && size == other.size;
+}
+
+/*
+ * Function: operator()
+ * Description: hashes a cache key by mixing its fields
+ * Parameters: key: key to hash
+ * Returns: the hash value
+ */
+std::size_t FileTypeDetector::CacheKeyHash::operator()(const CacheKey& key) const {
+    std::uint64_t h = key.inode * 0x9E3779B97F4A7C15ull;
+    h ^= key.device + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= static_cast<std::uint64_t>(key.mtimeSec) + (h << 6) + (h >> 2);
+    h ^= static_cast<std::uint64_t>(key.mtimeNsec) + (h << 6) + (h >> 2);
+    h ^= key.size + (h << 6) + (h >> 2);
+    return static_cast<std::size_t>(h);
+}
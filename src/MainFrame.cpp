@@ -5,6 +5,7 @@
  */
 
 #include "MainFrame.h"
+#include <algorithm>
 
 // Define the event table to map GUI events to class functions
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
@@ -17,6 +18,8 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_MENU(ID_COPY, MainFrame::OnCopy)
     EVT_MENU(ID_CUT, MainFrame::OnCut)
     EVT_MENU(ID_PASTE, MainFrame::OnPaste)
+    EVT_LIST_ITEM_SELECTED(wxID_ANY, MainFrame::OnItemSelected)
+    EVT_TIMER(ID_TYPE_TIMER, MainFrame::OnTypeTimer)
 wxEND_EVENT_TABLE()
 
 /*
@@ -26,7 +29,19 @@ wxEND_EVENT_TABLE()
  * Returns: void
  */
 MainFrame::MainFrame(const wxString& title) 
-    : wxFrame(NULL, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600)) {
+    : wxFrame(NULL, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600)),
+      m_typeDetector([this](unsigned long generation, long row, const std::string& type) {
+          // runs on a worker thread, hop back to the UI thread before touching the list
+          CallAfter([this, generation, row, type] { OnTypeDetected(generation, row, type); });
+      }),
+      m_typeGeneration(0),
+      m_typeTimer(this, ID_TYPE_TIMER),
+      m_lastTopItem(-1),
+      m_lastPageCount(-1),
+      m_revalidator([this](RevalidationResult result) {
+          CallAfter([this, result] { OnDirectoryRevalidated(result); });
+      }),
+      m_listGeneration(0) {
     
     CreateControls();
     SetupMenuBar();
@@ -35,6 +50,9 @@ MainFrame::MainFrame(const wxString& title)
     
     // initial load of cd
     UpdateList();
+
+    // there's no portable scroll event for wxListCtrl so poll the top row instead
+    m_typeTimer.Start(150);
 }
 
 /*
@@ -43,7 +61,9 @@ MainFrame::MainFrame(const wxString& title)
  * Parameters: none
  * Returns: void
  */
-MainFrame::~MainFrame() {}
+MainFrame::~MainFrame() {
+    m_typeTimer.Stop();
+}
 
 void MainFrame::CreateControls() {
     wxPanel* panel = new wxPanel(this);
@@ -65,12 +85,78 @@ void MainFrame::CreateControls() {
 
 /*
  * Function: UpdateList
- * Description: updates the file list control with the contents of the current working directory
- * Parameters: none
+ * Description: updates the file list control with the contents of the current working directory, re-listing it in the background
+ * Parameters: useSnapshot: show the last-known listing straight away, false to keep the current rows until the refresh lands (e.g. after an edit)
+ * Returns: void
+ */
+void MainFrame::UpdateList(bool useSnapshot) {
+    fs::path current = m_logic.GetCurrentPath();
+
+    if (!useSnapshot) {
+        m_listGeneration = m_revalidator.Request(current, nullptr, nullptr);
+        SetStatusText("Refreshing...", 1);
+        return;
+    }
+
+    std::vector<FileEntry> entries;
+    DirectoryStamp stamp;
+    bool cached = m_logic.GetSnapshotContents(current, entries, stamp);
+
+    // nothing here touches the filesystem, the worker does the slow part
+    PopulateList(entries);
+    m_listGeneration = m_revalidator.Request(current, cached ? &entries : nullptr, cached ? &stamp : nullptr);
+    SetStatusText(cached ? "Checking for changes..." : "Loading...", 1);
+}
+
+/*
+ * Function: OnDirectoryRevalidated
+ * Description: applies a background listing, leaving the rows alone if nothing changed and ignoring results for a directory we've left
+ * Parameters: result: the revalidation result
  * Returns: void
  */
-void MainFrame::UpdateList() {
+void MainFrame::OnDirectoryRevalidated(const RevalidationResult& result) {
+    if (result.generation != m_listGeneration) return;
+
+    if (result.missing) {
+        // a typed path, or a snapshot folder that has since gone, goes back to where we were
+        if (!m_fallbackPath.empty()) {
+            wxMessageBox("The directory does not exist.", "Navigation Error", wxOK | wxICON_ERROR);
+            m_logic.SetCurrentPath(m_fallbackPath);
+            m_pathBar->SetValue(m_fallbackPath.string());
+            m_fallbackPath.clear();
+            UpdateList();
+        } else {
+            SetStatusText(result.error, 1);
+        }
+        return;
+    }
+    m_fallbackPath.clear();
+
+    if (result.unchanged) {
+        SetStatusText("", 1);
+        return;
+    }
+
+    // a partial listing is still shown, but only a complete one is worth keeping
+    if (result.error.empty()) {
+        m_logic.RecordContents(result.path, result.stamp, result.entries);
+    }
+    PopulateList(result.entries);
+    SetStatusText(result.error, 1);
+}
+
+/*
+ * Function: PopulateList
+ * Description: fills the file list control with the given entries plus the .. row
+ * Parameters: entries: the directory items to show
+ * Returns: void
+ */
+void MainFrame::PopulateList(const std::vector<FileEntry>& entries) {
     m_fileList->DeleteAllItems();
+    m_typeGeneration = m_typeDetector.NewGeneration();
+    m_typeRequested.clear();
+    m_lastTopItem = -1;
+    m_lastPageCount = -1;
     
     fs::path current = m_logic.GetCurrentPath();
     
@@ -80,15 +166,84 @@ void MainFrame::UpdateList() {
         m_fileList->SetItem(index, 1, "Folder");
         m_fileList->SetItem(index, 2, "--");
         m_fileList->SetItem(index, 3, "--");
+        m_typeRequested.push_back(true);
     }
 
-    auto entries = m_logic.GetDirectoryContents(current);
-    
     for (const auto& entry : entries) {
         long index = m_fileList->InsertItem(m_fileList->GetItemCount(), entry.name);
         m_fileList->SetItem(index, 1, entry.type);
         m_fileList->SetItem(index, 2, entry.size);
         m_fileList->SetItem(index, 3, entry.modified);
+        // folders already have their final type
+        m_typeRequested.push_back(entry.isDirectory);
+    }
+
+    RequestVisibleTypes();
+}
+
+/*
+ * Function: RequestVisibleTypes
+ * Description: queues content type detection for the rows currently on screen plus a small margin
+ * Parameters: none
+ * Returns: void
+ */
+void MainFrame::RequestVisibleTypes() {
+    long top = m_fileList->GetTopItem();
+    if (top < 0) top = 0;
+    m_lastTopItem = top;
+    m_lastPageCount = m_fileList->GetCountPerPage();
+
+    long last = top + m_lastPageCount + 10;
+    for (long i = top; i < last; ++i) {
+        RequestType(i);
+    }
+}
+
+/*
+ * Function: RequestType
+ * Description: queues content type detection for one row if it hasn't been asked for yet
+ * Parameters: index: the list row to detect
+ * Returns: void
+ */
+void MainFrame::RequestType(long index) {
+    if (index < 0 || index >= static_cast<long>(m_typeRequested.size()) || m_typeRequested[index]) return;
+    m_typeRequested[index] = true;
+
+    fs::path file = m_logic.GetCurrentPath() / m_fileList->GetItemText(index, 0).ToStdString();
+    m_typeDetector.Request(file, index);
+}
+
+/*
+ * Function: OnTypeDetected
+ * Description: fills in the Type column when a detection result arrives, ignoring results for a previous listing
+ * Parameters: generation: listing the request belonged to, row: list row, type: detected type
+ * Returns: void
+ */
+void MainFrame::OnTypeDetected(unsigned long generation, long row, const std::string& type) {
+    if (generation != m_typeGeneration || row >= m_fileList->GetItemCount()) return;
+    m_fileList->SetItem(row, 1, type);
+}
+
+/*
+ * Function: OnItemSelected
+ * Description: makes sure the selected row gets its type detected even if it was never scrolled over
+ * Parameters: event: the wxListEvent object representing the selection event
+ * Returns: void
+ */
+void MainFrame::OnItemSelected(wxListEvent& event) {
+    RequestType(event.GetIndex());
+}
+
+/*
+ * Function: OnTypeTimer
+ * Description: requests types for newly visible rows once the list has been scrolled or resized to show more rows
+ * Parameters: event: the wxTimerEvent object for the poll
+ * Returns: void
+ */
+void MainFrame::OnTypeTimer(wxTimerEvent& event) {
+    long top = std::max(m_fileList->GetTopItem(), 0L);
+    if (top != m_lastTopItem || m_fileList->GetCountPerPage() != m_lastPageCount) {
+        RequestVisibleTypes();
     }
 }
 
@@ -113,17 +268,19 @@ void MainFrame::OnItemActivated(wxListEvent& event) {
     wxString itemName = m_fileList->GetItemText(index, 0);
     fs::path newPath = (m_logic.GetCurrentPath() / itemName.ToStdString()).lexically_normal();
 
-    if (fs::is_directory(newPath)) {
-        m_logic.SetCurrentPath(newPath);
-        m_pathBar->SetValue(newPath.string()); 
-        UpdateList();
-    }
-
-    if (fs::is_directory(newPath)) { // if directory
+    // the Type column already says whether it's a folder, so folders aren't stat'd on the UI thread.
+    // the row may come from an old snapshot, so go back here if the worker finds it gone
+    if (m_fileList->GetItemText(index, 1) == "Folder") { // if directory
+        if (m_fallbackPath.empty()) {
+            m_fallbackPath = m_logic.GetCurrentPath();
+        }
         m_logic.SetCurrentPath(newPath);
         m_pathBar->SetValue(newPath.string());
         UpdateList();
-    } else if (fs::exists(newPath)) { // if file
+    } else if (!fs::exists(newPath)) { // file deleted since the listing was taken
+        wxMessageBox("The file no longer exists.", "Open Error", wxOK | wxICON_ERROR);
+        UpdateList(false);
+    } else { // if file
         wxString pathString = wxString::FromUTF8(newPath.string().c_str());
         if (!wxLaunchDefaultApplication(pathString)) { // try linux default
             wxString wslCommand = wxString::Format("wslview \"%s\"", pathString); // try windows default via wsl
@@ -146,13 +303,12 @@ void MainFrame::OnPathEnter(wxCommandEvent& event) {
     std::string typedPath = m_pathBar->GetValue().ToStdString();
     fs::path newPath(typedPath);
 
-    if (fs::exists(newPath) && fs::is_directory(newPath)) {
-        m_logic.SetCurrentPath(newPath);
-        UpdateList();
-    } else {
-        wxMessageBox("The directory does not exist.", "Navigation Error", wxOK | wxICON_ERROR);
-        m_pathBar->SetValue(m_logic.GetCurrentPath().string());
+    // the worker checks the path, OnDirectoryRevalidated comes back here if it isn't a folder
+    if (m_fallbackPath.empty()) {
+        m_fallbackPath = m_logic.GetCurrentPath();
     }
+    m_logic.SetCurrentPath(newPath);
+    UpdateList();
 }
 
 /*
@@ -195,7 +351,7 @@ void MainFrame::OnCreateFolder(wxCommandEvent& event) {
     
     if (dialog.ShowModal() == wxID_OK) {
         if (m_logic.CreateFolder(dialog.GetValue().ToStdString())) {
-            UpdateList();
+            UpdateList(false);
         } else {
             wxMessageBox(m_logic.GetLastError(), "Folder Creation Error", wxOK | wxICON_ERROR);
         }
@@ -217,7 +373,7 @@ void MainFrame::OnRename(wxCommandEvent& event) {
         if (dialog.ShowModal() == wxID_OK) {
             fs::path oldPath = m_logic.GetCurrentPath() / oldName.ToStdString();
             if (m_logic.RenameItem(oldPath, dialog.GetValue().ToStdString())) {
-                UpdateList();
+                UpdateList(false);
             } else {
                 wxMessageBox(m_logic.GetLastError(), "Rename Error", wxOK | wxICON_ERROR);
             }
@@ -241,7 +397,7 @@ void MainFrame::OnDelete(wxCommandEvent& event) {
         if (answer == wxYES) {
             fs::path toDelete = m_logic.GetCurrentPath() / name.ToStdString();
             if (m_logic.DeleteItem(toDelete)) {
-                UpdateList();
+                UpdateList(false);
             }
         }
     }
@@ -298,7 +454,7 @@ void MainFrame::OnPaste(wxCommandEvent& event) {
     }
 
     if (m_logic.Paste(m_logic.GetCurrentPath(), overwrite)) {
-        UpdateList();
+        UpdateList(false);
         SetStatusText("Clipboard is now empty", 0);
     } else {
         wxMessageBox(m_logic.GetLastError(), "Paste Error", wxOK | wxICON_ERROR);
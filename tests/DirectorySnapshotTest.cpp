@@ -0,0 +1,171 @@
+/*
+ * Author: Mathew Lane
+ * Description: Checks the listing snapshot round trip, key normalization, the per-listing cap and rejection of corrupt files.
+ * Date: 2026-02-02
+ */
+
+#include "DirectorySnapshot.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+
+namespace {
+
+int failures = 0;
+
+// byte offsets into the on-disk layout (Header, then DirRecord[0])
+constexpr std::size_t VERSION_AT = 8;
+constexpr std::size_t DIR_COUNT_AT = 12;
+constexpr std::size_t ENTRY_OFFSET_AT = 32;
+constexpr std::size_t FIRST_DIR_AT = 56;
+constexpr std::size_t FIRST_ENTRY_AT = FIRST_DIR_AT + 16;
+constexpr std::size_t DIR_ENTRY_COUNT_AT = FIRST_DIR_AT + 24;
+
+/*
+ * Function: Check
+ * Description: reports a failed condition
+ * Parameters: name: test case name, ok: whether the condition held
+ * Returns: void
+ */
+void Check(const std::string& name, bool ok) {
+    if (!ok) {
+        std::cerr << "FAIL " << name << "\n";
+        ++failures;
+    }
+}
+
+/*
+ * Function: ReadBytes
+ * Description: reads a whole file into a string
+ * Parameters: path: file to read
+ * Returns: the file contents
+ */
+std::string ReadBytes(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/*
+ * Function: LoadsPatched
+ * Description: overwrites an integer at a byte offset in a copy of the snapshot, writes it out and tries to load it
+ * Parameters: bytes: valid snapshot contents, offset: where to write, value: value to write, file: scratch file to use
+ * Returns: whether Load accepted the patched file
+ */
+template <typename T>
+bool LoadsPatched(std::string bytes, std::size_t offset, T value, const fs::path& file) {
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+    std::ofstream(file, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+    DirectorySnapshot snapshot;
+    return snapshot.Load(file);
+}
+
+/*
+ * Function: LoadsBytes
+ * Description: writes raw bytes to a scratch file and tries to load it
+ * Parameters: bytes: file contents, file: scratch file to use
+ * Returns: whether Load accepted the file
+ */
+bool LoadsBytes(const std::string& bytes, const fs::path& file) {
+    std::ofstream(file, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+    DirectorySnapshot snapshot;
+    return snapshot.Load(file);
+}
+
+} // namespace
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / ("snapshot_test_" + std::to_string(getpid()));
+    fs::create_directories(dir / "listed");
+    fs::path file = dir / "snapshot.bin";
+    fs::path scratch = dir / "scratch.bin";
+
+    std::vector<FileEntry> listing = {
+        { "notes.txt", "TXT File", "12 B", "2026-02-02 10:00", false },
+        { "src", "Folder", "--", "2026-02-01 09:30", true },
+    };
+    DirectoryStamp stamp{ 1700000000, 42 };
+
+    // round trip through a save and a fresh load
+    {
+        DirectorySnapshot snapshot;
+        Check("load missing file", !snapshot.Load(file));
+        snapshot.Store(dir / "listed", stamp, listing);
+        snapshot.Store("/tmp", stamp, listing);
+        Check("save", snapshot.Save());
+    }
+    {
+        DirectorySnapshot snapshot;
+        Check("load saved file", snapshot.Load(file));
+
+        std::vector<FileEntry> entries;
+        DirectoryStamp found;
+        Check("lookup", snapshot.Lookup(dir / "listed", entries, found));
+        Check("entries match", entries == listing);
+        Check("stamp matches", found == stamp);
+
+        // the same folder spelled differently shares one key
+        Check("trailing slash", snapshot.Lookup("/tmp/", entries, found) && entries == listing);
+        Check("dot segment", snapshot.Lookup(dir / "listed" / ".", entries, found));
+        Check("unknown folder", !snapshot.Lookup(dir / "other", entries, found));
+    }
+
+    // listings over the entry cap aren't kept, and replace any older copy
+    {
+        DirectorySnapshot snapshot;
+        snapshot.Load(file);
+        std::vector<FileEntry> huge(DirectorySnapshot::MAX_ENTRIES_PER_LISTING + 1, listing[0]);
+        snapshot.Store(dir / "listed", stamp, huge);
+
+        std::vector<FileEntry> entries;
+        DirectoryStamp found;
+        Check("over cap not looked up", !snapshot.Lookup(dir / "listed", entries, found));
+        Check("save after cap", snapshot.Save());
+        Check("over cap not saved", !snapshot.Lookup(dir / "listed", entries, found));
+        Check("others kept", snapshot.Lookup("/tmp", entries, found));
+    }
+
+    // corrupt or truncated files are rejected rather than read past the mapping
+    std::string bytes = ReadBytes(file);
+    Check("control copy loads", LoadsBytes(bytes, scratch));
+    Check("bad version", !LoadsPatched<std::uint32_t>(bytes, VERSION_AT, DirectorySnapshot::VERSION + 1, scratch));
+    Check("huge dirCount", !LoadsPatched<std::uint32_t>(bytes, DIR_COUNT_AT, 0xFFFFFFFFu, scratch));
+    Check("dirCount one too many", !LoadsPatched<std::uint32_t>(bytes, DIR_COUNT_AT, 2, scratch));
+    Check("huge entryOffset", !LoadsPatched<std::uint64_t>(bytes, ENTRY_OFFSET_AT, ~std::uint64_t(0) - 8, scratch));
+    Check("firstEntry out of range", !LoadsPatched<std::uint64_t>(bytes, FIRST_ENTRY_AT, 1000, scratch));
+    Check("firstEntry wraps", !LoadsPatched<std::uint64_t>(bytes, FIRST_ENTRY_AT, ~std::uint64_t(0), scratch));
+    Check("entryCount out of range", !LoadsPatched<std::uint64_t>(bytes, DIR_ENTRY_COUNT_AT, ~std::uint64_t(0), scratch));
+    Check("truncated by one byte", !LoadsBytes(bytes.substr(0, bytes.size() - 1), scratch));
+    Check("truncated header", !LoadsBytes(bytes.substr(0, 10), scratch));
+    Check("empty file", !LoadsBytes("", scratch));
+
+    // past the byte budget the least recently used listings are left out
+    {
+        DirectorySnapshot snapshot;
+        snapshot.Load(file);
+        FileEntry wide = listing[0];
+        wide.name = std::string(200, 'x');
+        std::vector<FileEntry> big(DirectorySnapshot::MAX_ENTRIES_PER_LISTING, wide);
+        for (int i = 0; i < 8; ++i) {
+            snapshot.Store(dir / ("big" + std::to_string(i)), stamp, big);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2)); // distinct recency
+        }
+        Check("save over budget", snapshot.Save());
+        Check("file within budget", fs::file_size(file) <= DirectorySnapshot::MAX_SNAPSHOT_BYTES);
+
+        std::vector<FileEntry> entries;
+        DirectoryStamp found;
+        Check("newest kept", snapshot.Lookup(dir / "big7", entries, found) && entries.size() == big.size());
+        Check("oldest dropped", !snapshot.Lookup(dir / "big0", entries, found));
+    }
+
+    fs::remove_all(dir);
+
+    if (failures == 0) std::cout << "All snapshot tests passed\n";
+    return failures == 0 ? 0 : 1;
+}
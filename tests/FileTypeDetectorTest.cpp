@@ -0,0 +1,103 @@
+/*
+ * Author: Mathew Lane
+ * Description: Checks content type detection against real headers and text files that happen to start with magic bytes.
+ * Date: 2026-02-02
+ */
+
+#include "FileTypeDetector.h"
+#include "FileManagerLogic.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+int failures = 0;
+
+/*
+ * Function: Check
+ * Description: compares an actual type label with the expected one and reports mismatches
+ * Parameters: name: test case name, actual: detected label, expected: wanted label
+ * Returns: void
+ */
+void Check(const std::string& name, const std::string& actual, const std::string& expected) {
+    if (actual != expected) {
+        std::cerr << "FAIL " << name << ": got \"" << actual << "\", expected \"" << expected << "\"\n";
+        ++failures;
+    }
+}
+
+/*
+ * Function: WriteFile
+ * Description: writes raw bytes to a file in the scratch directory
+ * Parameters: path: file to write, bytes: contents
+ * Returns: the path written
+ */
+fs::path WriteFile(const fs::path& path, const std::string& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    return path;
+}
+
+/*
+ * Function: Buffer
+ * Description: runs DetectFromBuffer over a string
+ * Parameters: bytes: header bytes, extension: lowercase extension without the dot, empty if none
+ * Returns: the detected label
+ */
+std::string Buffer(const std::string& bytes, const std::string& extension) {
+    return FileTypeDetector::DetectFromBuffer(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), extension);
+}
+
+} // namespace
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / ("filetype_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    FileTypeDetector detector(nullptr, 1);
+
+    // real headers
+    Check("png", Buffer(std::string("\x89PNG\r\n\x1a\n", 8), ""), "PNG Image");
+    std::string bmp("BM\x46\x00\x00\x00\x00\x00\x00\x00\x36\x00\x00\x00\x28\x00\x00\x00", 18);
+    Check("bmp", Buffer(bmp, ""), "BMP Image");
+    std::string pe(0x84, '\0');
+    pe[0] = 'M'; pe[1] = 'Z'; pe[0x3C] = 0x80; pe[0x80] = 'P'; pe[0x81] = 'E';
+    Check("pe", Buffer(pe, ""), "Windows Executable");
+    Check("mp4", Buffer(std::string("\0\0\0\x18" "ftypisom", 12), ""), "MP4 Video");
+    Check("quicktime", Buffer(std::string("\0\0\0\x14" "ftypqt  ", 12), ""), "QuickTime Video");
+
+    // text that starts with magic bytes must not be taken for a binary format
+    Check("bmw text", Buffer("BMW notes for the weekend", ""), "");
+    Check("mz text", Buffer("MZ is a short name for this file", ""), "");
+    Check("shebang with extension", Buffer("#!/bin/sh\necho hi\n", "sh"), "");
+    Check("shebang without extension", Buffer("#!/bin/sh\necho hi\n", ""), "Script File");
+
+    // whole files through Detect, extension fallback and labels
+    Check("notes.txt", detector.Detect(WriteFile(dir / "notes.txt", "BMW notes")), "TXT File");
+    Check("program.txt", detector.Detect(WriteFile(dir / "program.txt", "MZ hello")), "TXT File");
+    Check("run.sh", detector.Detect(WriteFile(dir / "run.sh", "#!/bin/sh\n")), "SH File");
+    Check("misnamed archive", detector.Detect(WriteFile(dir / "archive.txt", std::string("\x1f\x8b\x08\0\0\0\0\0", 8))), "GZIP Archive");
+    Check("no extension text", detector.Detect(WriteFile(dir / "README", "plain words\n")), "Text File");
+    Check("no extension binary", detector.Detect(WriteFile(dir / "blob", std::string("\x01\x02\0\x03", 4))), "Binary File");
+    // container formats defer to an extension from their family, and iso media brands are told apart
+    std::string zip("PK\x03\x04\x14\0\0\0\x08\0", 10);
+    std::string ole("\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1", 8);
+    Check("docx", detector.Detect(WriteFile(dir / "report.docx", zip)), "DOCX File");
+    Check("jar", detector.Detect(WriteFile(dir / "app.jar", zip)), "JAR File");
+    Check("xls", detector.Detect(WriteFile(dir / "sheet.xls", ole)), "XLS File");
+    Check("zip without extension", detector.Detect(WriteFile(dir / "download", zip)), "ZIP Archive");
+    Check("m4a", detector.Detect(WriteFile(dir / "song.m4a", std::string("\0\0\0\x20" "ftypM4A ", 12))), "M4A Audio");
+    Check("heic", detector.Detect(WriteFile(dir / "photo.heic", std::string("\0\0\0\x18" "ftypheic", 12))), "HEIC Image");
+    Check("unknown brand mov", detector.Detect(WriteFile(dir / "clip.mov", std::string("\0\0\0\x14" "ftypwxyz", 12))), "MOV File");
+    Check("empty", detector.Detect(WriteFile(dir / "empty.log", "")), "Empty File");
+    Check("extension label", FileManagerLogic::ExtensionLabel("photo.jpeg"), "JPEG File");
+    Check("no extension label", FileManagerLogic::ExtensionLabel("Makefile"), "File");
+
+    fs::remove_all(dir);
+
+    if (failures == 0) std::cout << "All file type tests passed\n";
+    return failures == 0 ? 0 : 1;
+}